@@ -0,0 +1,99 @@
+/***********************************************************************
+               Verification sur PC de l'objet LinkyCost.
+
+Une meme consommation est fournie groupe par groupe (index decoupe)
+et en un seul saut par periode (index non decoupe) : day() et month()
+doivent etre identiques, et egaux au cout exact
+sum(dWh x prix) / 1000 arrondi par defaut.
+
+Retourne 0 si tout est correct, 1 sinon.
+
+***********************************************************************/
+
+/***************************** Includes *******************************/
+#include <stdio.h>
+#include <stdint.h>
+#include "LinkyCost.h"
+
+/************************* Defines and const  **************************/
+const uint8_t CCk_NbHours = 48;   /* Simulated hours */
+const uint16_t CCk_NbGrp = 240;   /* Groups per hour and period */
+
+/****************************** Code **********************************/
+static uint32_t Rnd()
+  {  /* Small deterministic LCG, same sequence on every host */
+  static uint32_t x = 12345;
+
+  x = x * 1103515245 + 12345;
+  return (x >> 16) & 0x7fff;
+  }
+
+static bool Check(const char *Name, uint32_t Got, uint32_t Exp)
+  {
+  if (Got != Exp)
+    {
+    printf("%s : %lu, attendu %lu\n", Name, (unsigned long) Got, \
+           (unsigned long) Exp);
+    return false;
+    }
+  return true;
+  }
+
+int main()
+  {
+  LinkyCost Split, Whole;
+  uint32_t Idx[CCo_NbPer] = {1000000, 2000000};
+  uint32_t Start[CCo_NbPer];
+  uint64_t Exact = 0;
+  uint16_t g;
+  uint8_t h, p;
+  bool Ok = true;
+
+  Split.Init();
+  Whole.Init();
+  for (p = 0; p < CCo_NbPer; p++)
+    {  /* First index, reference only */
+    Split.Index(p, Idx[p]);
+    Whole.Index(p, Idx[p]);
+    }
+
+  for (h = 0; h < CCk_NbHours; h++)
+    {
+    if ((h % 24) == 0)
+      {  /* New day, new month every other day */
+      Split.NewDay((h % 48) == 0);
+      Whole.NewDay((h % 48) == 0);
+      }
+    for (p = 0; p < CCo_NbPer; p++)
+      {
+      Start[p] = Idx[p];
+      }
+    for (g = 0; g < CCk_NbGrp; g++)
+      {  /* Periods interleaved, 0..15 Wh per group */
+      p = Rnd() % CCo_NbPer;
+      Idx[p] += Rnd() % 16;
+      Split.Index(p, Idx[p]);
+      }
+    for (p = 0; p < CCo_NbPer; p++)
+      {
+      Whole.Index(p, Idx[p]);
+      Exact += (uint64_t) (Idx[p] - Start[p]) * Split.price(p);
+      }
+    if ((h % 24) == 23)
+      {
+      Ok &= Check("day", Split.day(), Whole.day());
+      }
+    }
+
+  Ok &= Check("day", Split.day(), Whole.day());
+  Ok &= Check("month", Split.month(), Whole.month());
+  Ok &= Check("month exact", Split.month(), \
+              (uint32_t) (Exact / 1000) + 2 * Split.sub());
+  Ok &= Check("skipped", Split.skipped(), 0);
+
+  printf("%s : day %lu mc, month %lu mc\n", Ok ? "OK" : "ECHEC", \
+         (unsigned long) Split.day(), (unsigned long) Split.month());
+  return Ok ? 0 : 1;
+  }
+
+/*************************** End of code ******************************/
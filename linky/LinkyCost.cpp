@@ -0,0 +1,209 @@
+/***********************************************************************
+               Objet calcul du cout de la consommation
+               par periode tarifaire.
+
+V10e : initial version.
+
+***********************************************************************/
+
+/***************************** Includes *******************************/
+#include <string.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <EEPROM.h>
+#endif
+#include "LinkyCost.h"
+
+/***********************************************************************
+                  Calcul du cout
+
+  Pour chaque nouvel index de la periode Per :
+    dWh  = index - index precedent
+    Rem  = Rem + dWh x prix(Per)          en mc / 1000
+    cout = cout + Rem / 1000, Rem = Rem % 1000
+
+  Le reste est conserve d'un groupe a l'autre : aucun arrondi ne se
+  cumule, le total est exact a 1 mc pres quel que soit le decoupage.
+  Le premier index d'une periode et un index qui recule ne sont pas
+  factures : ils deviennent la nouvelle reference. Un saut de plus de
+  CCo_MaxDelta Wh devient aussi la reference ; il n'est pas facture
+  mais cumule dans skipped() pour etre rapproche a la main.
+
+  Cout horaire : Pa (VA) x prix (mc/kWh) / 1000 = mc/h, calcule en
+  deux parties (prix / 1000 et prix % 1000) pour rester sur 32 bits.
+
+  Les prix sont bornes a CCo_MaxPrice, a la saisie comme au chargement
+  depuis l'EEPROM : un tarif hors bornes est remplace par le defaut.
+
+***********************************************************************/
+
+/****************************** Macros ********************************/
+#ifndef ARDUINO
+#define PROGMEM
+#define memcpy_P memcpy
+#endif
+
+/************************* Defines and const  **************************/
+const uint8_t CCo_Magic = 0xA5;   /* Tariff saved in EEPROM */
+
+/************************* Donnees en progmem *************************/
+/* Tarif par defaut : HP 0,2700 EUR, HC 0,2068 EUR, abonnement
+ * 0,5175 EUR / jour. En BASE, seul le prix HP est utilise. */
+const uint32_t PCo_Def[CCo_NbPer + 1] PROGMEM = {27000, 20680, 51750};
+
+/*************** Constructor, methods and properties ******************/
+LinkyCost::LinkyCost()
+  {
+  uint8_t i;
+
+  for (i = 0; i < CCo_NbPer; i++)
+    {
+    _Idx[i] = 0;
+    }
+  _Day = 0;
+  _Month = 0;
+  _Skip = 0;
+  _Rem = 0;
+  }
+
+void LinkyCost::Init()
+  {
+  uint32_t Def[CCo_NbPer + 1];
+  uint8_t i;
+
+  #ifdef ARDUINO
+  EEPROM.get(CCo_EeAddr, _Tf);
+  for (i = 0; i < CCo_NbPer; i++)
+    {
+    if (_Tf.price[i] > CCo_MaxPrice)
+      {  /* Corrupted tariff */
+      _Tf.magic = 0;
+      }
+    }
+  if (_Tf.sub > CCo_MaxSub)
+    {
+    _Tf.magic = 0;
+    }
+  #else
+  _Tf.magic = 0;
+  #endif
+
+  if (_Tf.magic != CCo_Magic)
+    {  /* Nothing valid saved, default tariff */
+    memcpy_P(Def, PCo_Def, sizeof(Def));
+    for (i = 0; i < CCo_NbPer; i++)
+      {
+      _Tf.price[i] = Def[i];
+      }
+    _Tf.sub = Def[CCo_NbPer];
+    _Tf.magic = CCo_Magic;
+    }
+  }
+
+void LinkyCost::Index(uint8_t Per, uint32_t Wh)
+  {
+  uint32_t d, mc;
+
+  if (Per >= CCo_NbPer)
+    {
+    return;
+    }
+
+  d = Wh - _Idx[Per];
+  if ((_Idx[Per] == 0) || (Wh < _Idx[Per]))
+    {  /* No valid reference, just take it */
+    _Idx[Per] = Wh;
+    return;
+    }
+  if (d > CCo_MaxDelta)
+    {  /* Too large to charge, keep track of it */
+    _Skip += d;
+    _Idx[Per] = Wh;
+    return;
+    }
+  _Idx[Per] = Wh;
+
+  d = d * _Tf.price[Per] + _Rem;   /* <= CCo_MaxDelta x CCo_MaxPrice
+                                    * + 999, fits */
+  mc = d / 1000;
+  _Rem = (uint16_t) (d % 1000);
+
+  _Day += mc;
+  _Month += mc;
+  }
+
+void LinkyCost::NewDay(bool Month)
+  {
+  _Day = _Tf.sub;
+  if (Month)
+    {
+    _Month = 0;
+    }
+  _Month += _Tf.sub;
+  }
+
+uint32_t LinkyCost::day()
+  {
+  return _Day;
+  }
+
+uint32_t LinkyCost::month()
+  {
+  return _Month;
+  }
+
+uint32_t LinkyCost::rate(uint16_t Pa, uint8_t Per)
+  {
+  if (Per >= CCo_NbPer)
+    {
+    Per = 0;
+    }
+  return (uint32_t) Pa * (_Tf.price[Per] / 1000) + \
+         ((uint32_t) Pa * (_Tf.price[Per] % 1000)) / 1000;
+  }
+
+uint32_t LinkyCost::skipped()
+  {
+  return _Skip;
+  }
+
+uint32_t LinkyCost::price(uint8_t Per)
+  {
+  return (Per < CCo_NbPer) ? _Tf.price[Per] : 0;
+  }
+
+uint32_t LinkyCost::sub()
+  {
+  return _Tf.sub;
+  }
+
+bool LinkyCost::SetPrice(uint8_t Per, uint32_t Mc)
+  {
+  if ((Per >= CCo_NbPer) || (Mc > CCo_MaxPrice))
+    {
+    return false;
+    }
+  _Tf.price[Per] = Mc;
+  return true;
+  }
+
+bool LinkyCost::SetSub(uint32_t Mc)
+  {
+  if (Mc > CCo_MaxSub)
+    {
+    return false;
+    }
+  _Tf.sub = Mc;
+  return true;
+  }
+
+void LinkyCost::Save()
+  {
+  #ifdef ARDUINO
+  EEPROM.put(CCo_EeAddr, _Tf);
+  #endif
+  }
+
+/***********************************************************************
+               Fin d'objet calcul du cout
+***********************************************************************/
@@ -0,0 +1,95 @@
+/***********************************************************************
+               Objet calcul du cout de la consommation
+               par periode tarifaire.
+
+Cumule le cout a partir des deltas d'index (BASE ou HCHC / HCHP) a
+chaque groupe decode :
+ - table tarifaire : prix du kWh par periode, abonnement par jour,
+   valeurs par defaut en PROGMEM, modifiables et sauvees en EEPROM,
+ - cout en millicentimes (1 EUR = 100 000 mc), entiers uniquement,
+ - cout du jour et du mois en cours, cout horaire instantane a partir
+   de PAPP (majorant, PAPP est en VA et non en W).
+
+Aucun calcul flottant : le meme code compile sur PC (host) donne des
+resultats identiques au bit pres, pour le rapprochement des factures.
+Le total ne depend pas du decoupage des index : verifie par
+host/cost_check.cpp (cmake -S host -B _gate_build, puis ctest).
+
+Les cumuls du jour et du mois sont en RAM : ils sont perdus a chaque
+reset (redemarrage, baisse de tension) et repartent de 0. Aucun
+abonnement n'est facture au demarrage, seulement a chaque NewDay().
+
+V10e : initial version.
+
+***********************************************************************/
+#ifndef _LinkyCost
+#define _LinkyCost true
+
+/*************************** Includes ********************************/
+#include <stdint.h>
+
+/********************** Defines and consts ***************************/
+#define CCo_NbPer 2            /* Number of tariff periods */
+
+const uint16_t CCo_EeAddr = 0;     /* Address of the tariff in EEPROM */
+const uint32_t CCo_MaxPrice = 400000;
+                        /* Maximum price in mc per kWh, keeps
+                         * CCo_MaxDelta x price in 32 bits */
+const uint32_t CCo_MaxSub = 10000000;
+                        /* Maximum subscription in mc per day */
+const uint32_t CCo_MaxDelta = 10000;
+                        /* Maximum index step in Wh for one group,
+                         * above it the index is taken as a new
+                         * reference (meter change, corrupted value)
+                         * and the step is counted in skipped() */
+
+/******************************** Class *******************************
+      LinkyCost : cost of the consumption per tariff period
+***********************************************************************/
+
+class LinkyCost
+  {
+  public:
+    LinkyCost();        /* Constructor */
+
+    void Init();        /* Loads the tariff, call from setup(),
+                         * totals start from 0 */
+    void Index(uint8_t Per, uint32_t Wh);
+                        /* New index Wh of period Per, 0 = HP or
+                         * BASE, 1 = HC (cf. LinkyHistTIC::Tarifs) */
+    void NewDay(bool Month = false);
+                        /* Start of a new day (and month if Month),
+                         * charges the daily subscription */
+
+    uint32_t day();     /* Cost of the day in mc */
+    uint32_t month();   /* Cost of the month in mc */
+    uint32_t rate(uint16_t Pa, uint8_t Per);
+                        /* Cost per hour in mc at Pa VA in period Per */
+    uint32_t skipped(); /* Wh of the steps not charged since boot */
+
+    uint32_t price(uint8_t Per);    /* Price of the kWh in mc */
+    uint32_t sub();                 /* Subscription per day in mc */
+    bool SetPrice(uint8_t Per, uint32_t Mc);
+                        /* False, tariff unchanged, if Per or Mc
+                         * is out of range (CCo_MaxPrice) */
+    bool SetSub(uint32_t Mc);       /* Idem, CCo_MaxSub */
+    void Save();        /* Saves the tariff in EEPROM */
+
+  private:
+    struct Tariff
+      {
+      uint8_t magic;                /* Valid tariff in EEPROM */
+      uint32_t price[CCo_NbPer];    /* Price of the kWh in mc */
+      uint32_t sub;                 /* Subscription per day in mc */
+      };
+
+    Tariff _Tf;                 /* Current tariff */
+    uint32_t _Idx[CCo_NbPer];   /* Last index per period, 0 = none */
+    uint32_t _Day;              /* Cost of the day in mc */
+    uint32_t _Month;            /* Cost of the month in mc */
+    uint32_t _Skip;             /* Wh not charged (too large steps) */
+    uint16_t _Rem;              /* Remainder in mc / 1000 */
+  };
+
+#endif /* _LinkyCost */
+/*************************** End of code ******************************/
@@ -16,6 +16,10 @@ V10a : initial version, parametric.
 V10b : fixed bug in ptecIsNew().
 V10c : added LKYSIMINPUT mode
 V10d : adapted to Arduino Uno and Mega.
+V10e : even parity check, resync on LF/STX/ETX/EOT, error classes.
+       added frameIsNew().
+       ITri : fixed missing break after IINSTx, added IMAXx, PMAX and
+       ADIRx, _DNFR on 16 bits.
 
 ***********************************************************************/
 
@@ -43,13 +47,15 @@ V10d : adapted to Arduino Uno and Mega.
 
   _FR : flag register
 
-    |  7  |  6  |   5  |   4  |   3  |  2  |   1  |   0  |
-    |     |     | _Dec | _GId | _Cks |     | _RxB | _Rec |
+    |  7   |  6   |   5  |   4  |   3  |  2  |   1  |   0  |
+    | _Frm | _Err | _Dec | _GId | _Cks |     | _RxB | _Rec |
 
      _Rec : receiving
      _RxB : receive in buffer B, decode in buffer A
      _GId : Group identification
      _Dec : decode data
+     _Err : a line error has occurred, cf. errIsNew()
+     _Frm : end of frame received, cf. frameIsNew()
 
   _DNFR : data available flags
 
@@ -57,6 +63,10 @@ V10d : adapted to Arduino Uno and Mega.
     |     | _iinst3 | _iinst2 | _iinst1 | _ptec | _hchc | _hchp | _papp |
     |     |         |         |  _iinst |       |       | _base |       |
 
+    LKY_ITri only, _DNFR on 16 bits, bit 7 = _imax1 :
+    | 15  |   14   |   13   |   12   |  11  |  10   |    9   |    8   |
+    |     | _adir3 | _adir2 | _adir1 |      | _pmax | _imax3 | _imax2 |
+
                               ********************
 
   Exemple of group :
@@ -72,6 +82,22 @@ V10d : adapted to Arduino Uno and Mega.
 
     The storing stops at CRC (included), ie a max of 19 chars
 
+                              ********************
+
+  Line errors :
+    The TIC is 7E1. Each byte is checked for even parity before the
+    parity bit is stripped (unless LKY_NOPARITY). Any error aborts the
+    group being received, so that a corrupted group can never reach
+    the checksum with a lucky sum.
+    Resynchronisation is immediate :
+      <LF>             : restarts a new group, even in mid group,
+      <STX>/<ETX>/<EOT> : aborts the group, waits for the next <LF>.
+    Error classes (Errors) :
+      C_Err_Parity  : parity error on a received byte,
+      C_Err_Overrun : group longer than the buffer,
+      C_Err_Cks     : wrong checksum,
+      C_Err_Frame   : group interrupted by LF/STX/ETX/EOT, or too short.
+
 ***********************************************************************/
 
 
@@ -114,9 +140,14 @@ const uint8_t bLy_RxB = 0x02;  /* Receive in buffer B */
 const uint8_t bLy_Cks = 0x08;  /* Check Cks */
 const uint8_t bLy_GId = 0x10;  /* Group identification */
 const uint8_t bLy_Dec = 0x20;  /* Decode */
+const uint8_t bLy_Err = 0x40;  /* New line error */
+const uint8_t bLy_Frm = 0x80;  /* End of frame */
 
 const char Car_SP = 0x20;     /* Char space */
 const char Car_HT = 0x09;     /* Horizontal tabulation */
+const char Car_STX = 0x02;    /* Start of text (frame) */
+const char Car_ETX = 0x03;    /* End of text (frame) */
+const char Car_EOT = 0x04;    /* End of transmission (frame interrupted) */
 
 const uint8_t CLy_MinLg = 8;  /* Minimum useful message length */
 
@@ -125,7 +156,9 @@ const char CLy_Sep[] = {Car_SP, Car_HT, '\0'};  /* Separators */
 /***  const below are used for _GId and for flag rank in _DNFR ***/
 const uint8_t  CLy_papp = 0,  \
   CLy_base = 1, CLy_hchp = 1, CLy_hchc = 2, CLy_ptec = 3,  \
-  CLy_iinst = 4, CLy_iinst1 = 4, CLy_iinst2 = 5, CLy_iinst3 = 6;
+  CLy_iinst = 4, CLy_iinst1 = 4, CLy_iinst2 = 5, CLy_iinst3 = 6,  \
+  CLy_imax1 = 7, CLy_imax2 = 8, CLy_imax3 = 9, CLy_pmax = 10,  \
+  CLy_adir1 = 12, CLy_adir2 = 13, CLy_adir3 = 14;
 
 #ifdef LKY_IMono
 enum Phases:uint8_t {C_Phase_1, C_Phase_2, C_Phase_3};
@@ -149,6 +182,23 @@ P1(PLy_HC)    = "HC";         /* Tarif HC (default = HP) */
 P1(PLy_iinst) = "IINST";
 #endif
 
+#ifdef LKY_ITri
+P1(PLy_imax)  = "IMAX";
+P1(PLy_pmax)  = "PMAX";
+P1(PLy_adir)  = "ADIR";
+#endif
+
+/************************** Local functions ***************************/
+#ifndef LKY_NOPARITY
+static inline bool Ly_ParityOdd(uint8_t c)
+  {   /* True if c has an odd number of bits at 1 (7E1 error) */
+  c ^= c >> 4;
+  c ^= c >> 2;
+  c ^= c >> 1;
+  return c & 0x01;
+  }
+#endif
+
 /*************** Constructor, methods and properties ******************/
 #ifdef LKYSOFTSERIAL
 LinkyHistTIC::LinkyHistTIC(uint8_t pin_Rx, uint8_t pin_Tx) \
@@ -166,6 +216,7 @@ LinkyHistTIC::LinkyHistTIC(uint8_t pin_Rx, uint8_t pin_Tx)
   _iRec = 0;
   _iCks = 0;
   _GId = CLy_papp;
+  _Err = 0;
   
   #ifdef LKYSOFTSERIAL
   _pin_Rx = pin_Rx;
@@ -207,8 +258,16 @@ void LinkyHistTIC::Init(uint16_t BdR)
   for (i = 0; i < 3; i++)
     {
     _iinst[i] = 0;
+    _imax[i] = 0;
+    _adir[i] = 0;
     }
+  _pmax = 0;
   #endif
+
+  for (i = 0; i < C_Err_Nb; i++)
+    {
+    _ErrCnt[i] = 0;
+    }
   }
 
 void LinkyHistTIC::Update()
@@ -310,6 +369,36 @@ void LinkyHistTIC::Update()
           _iinst[j] = i;
           SetBits(_DNFR, (1<<_GId));
           }
+        break;
+
+      case CLy_imax1:
+      case CLy_imax2:
+      case CLy_imax3:
+        i = (uint8_t) atoi(_pDec);
+        j = _GId - CLy_imax1;
+        if (_imax[j] != i)
+          {  /* New value for _imax[] */
+          _imax[j] = i;
+          SetBits(_DNFR, (1<<_GId));
+          }
+        break;
+
+      case CLy_pmax:
+        ba = atol(_pDec);
+        if (_pmax != ba)
+          {  /* New value for _pmax */
+          _pmax = ba;
+          SetBits(_DNFR, (1<<CLy_pmax));
+          }
+        break;
+
+      case CLy_adir1:
+      case CLy_adir2:
+      case CLy_adir3:
+        /* Overload : flag every reception, even unchanged */
+        _adir[_GId - CLy_adir1] = (uint8_t) atoi(_pDec);
+        SetBits(_DNFR, (1<<_GId));
+        break;
       #endif
 
       default:
@@ -380,6 +469,38 @@ void LinkyHistTIC::Update()
         }
     #endif
 
+    #ifdef LKY_ITri
+    if (Run && ((strncmp_P(_pDec, PLy_imax, 4) == 0) || \
+                (strncmp_P(_pDec, PLy_adir, 4) == 0)))
+      {   /*  Format :
+           *    IMAXx   ADIRx   x = 1, 2 or 3
+           *    01234   01234
+           */
+      i = (*_pDec == 'I') ? CLy_imax1 : CLy_adir1;
+      switch (*(_pDec+4))
+        {
+        case '2':   /* Phase 2 */
+          _GId = C_Phase_2 + i;
+          break;
+
+        case '3':   /* Phase 3 */
+          _GId = C_Phase_3 + i;
+          break;
+
+        default:   /* Phase 1 */
+          _GId = C_Phase_1 + i;
+          break;
+        }    /* End switch */
+
+      Run = false;
+      }
+    if (Run && (strcmp_P(_pDec, PLy_pmax) == 0))
+      {
+      Run = false;
+      _GId = CLy_pmax;
+      }
+    #endif
+
     if (!Run)
       {
       SetBits(_FR, bLy_Dec);   /* Next = decode */
@@ -391,8 +512,8 @@ void LinkyHistTIC::Update()
     {
     ResetBits(_FR, bLy_Cks);   /* Clear requesting flag */
     cks = 0;
-    if (_iCks >= CLy_MinLg)
-      {   /* Message is long enough */
+    if ((_iCks >= CLy_MinLg) && (_iCks < CLy_BfSz))
+      {   /* Message is long enough (an empty group wraps _iCks) */
       for (i = 0; i < _iCks - 1; i++)
         {
         cks += *(_pDec + i);
@@ -408,23 +529,62 @@ void LinkyHistTIC::Update()
         *(_pDec + _iCks-1) = '\0';
                        /* Terminate the string just before the Cks */
         SetBits(_FR, bLy_GId);  /* Next step, group identification */
-
-        #ifdef LINKYDEBUG
         }
         else
-        {
+        {   /* Cks error, drop the group */
+        _SetErr(C_Err_Cks);
+
+        #ifdef LINKYDEBUG
         i = *(_pDec + _iCks);
         Serial << F("Error Cks ") << cks << F(" - ") << i << endl;
         #endif
-        }   /* Else, Cks error, do nothing */
+        }
 
-      }     /* Message too short, do nothing */
+      }
+      else
+      {     /* Message too short, drop it */
+      _SetErr(C_Err_Frame);
+      }
     }
 
   /* 4th part, receiver processing */
   while (_LKY.available())
     {  /* At least 1 char has been received */
-    c = _LKY.read() & 0x7f;   /* Read char, exclude parity */
+    c = _LKY.read();          /* Read char, with parity */
+
+    #ifndef LKY_NOPARITY
+    if (Ly_ParityOdd(c))
+      {  /* Parity error, abort the group and wait for next <LF> */
+      ResetBits(_FR, bLy_Rec);
+      _SetErr(C_Err_Parity);
+      continue;
+      }
+    #endif
+
+    c &= 0x7f;                /* Exclude parity */
+
+    if ((c == '\n') || (c == Car_STX) || (c == Car_ETX) || \
+        (c == Car_EOT))
+      {  /* Group or frame delimiter, resynchronise */
+      if (_FR & bLy_Rec)
+        {  /* Group interrupted */
+        _SetErr(C_Err_Frame);
+        }
+      if (c == '\n')
+        {   /* Received start of group char */
+        _iRec = 0;
+        SetBits(_FR, bLy_Rec);   /* Start reception */
+        }
+        else
+        {
+        ResetBits(_FR, bLy_Rec); /* Wait for next <LF> */
+        if (c == Car_ETX)
+          {
+          SetBits(_FR, bLy_Frm); /* End of frame */
+          }
+        }
+      continue;
+      }
 
     if (_FR & bLy_Rec)
       {  /* On going reception */
@@ -456,21 +616,56 @@ void LinkyHistTIC::Update()
         _iRec += 1;
         if (_iRec >= CLy_BfSz-1)
           {  /* Buffer overrun */
-          ResetBits(_FR, bLy_Rec); /* Stop reception and do nothing */
+          ResetBits(_FR, bLy_Rec); /* Stop reception */
+          _SetErr(C_Err_Overrun);
           }
         }  /* End other character than '\r' */
       }    /* End on-going reception */
-      else
-      {    /* Reception not yet started */
-      if (c == '\n')
-        {   /* Received start of group char */
-        _iRec = 0;
-        SetBits(_FR, bLy_Rec);   /* Start reception */
-        }
-      }
+           /* Else, reception not yet started, wait for <LF> */
     }  /* End while */
   }
 
+void LinkyHistTIC::_SetErr(uint8_t Cl)
+  {
+  _Err = Cl;
+  _ErrCnt[Cl] += 1;
+  SetBits(_FR, bLy_Err);
+  }
+
+bool LinkyHistTIC::errIsNew()
+  {
+  bool Res = false;
+
+  if(_FR & bLy_Err)
+    {
+    Res = true;
+    ResetBits(_FR, bLy_Err);
+    }
+  return Res;
+  }
+
+uint8_t LinkyHistTIC::err()
+  {
+  return _Err;
+  }
+
+uint16_t LinkyHistTIC::errCount(uint8_t Cl)
+  {
+  return (Cl < C_Err_Nb) ? _ErrCnt[Cl] : 0;
+  }
+
+bool LinkyHistTIC::frameIsNew()
+  {
+  bool Res = false;
+
+  if(_FR & bLy_Frm)
+    {
+    Res = true;
+    ResetBits(_FR, bLy_Frm);
+    }
+  return Res;
+  }
+
 bool LinkyHistTIC::pappIsNew()
   {
   bool Res = false;
@@ -593,6 +788,57 @@ uint8_t LinkyHistTIC::iinst(uint8_t Ph)
   {
   return _iinst[Ph];
   }
+
+bool LinkyHistTIC::imaxIsNew(uint8_t Ph)
+  {
+  bool Res = false;
+
+  if(_DNFR & (1<<(CLy_imax1 + Ph)))
+    {
+    Res = true;
+    ResetBits(_DNFR, (1<<(CLy_imax1 + Ph)));
+    }
+  return Res;
+  }
+
+uint8_t LinkyHistTIC::imax(uint8_t Ph)
+  {
+  return _imax[Ph];
+  }
+
+bool LinkyHistTIC::pmaxIsNew()
+  {
+  bool Res = false;
+
+  if(_DNFR & (1<<CLy_pmax))
+    {
+    Res = true;
+    ResetBits(_DNFR, (1<<CLy_pmax));
+    }
+  return Res;
+  }
+
+uint32_t LinkyHistTIC::pmax()
+  {
+  return _pmax;
+  }
+
+bool LinkyHistTIC::adirIsNew(uint8_t Ph)
+  {
+  bool Res = false;
+
+  if(_DNFR & (1<<(CLy_adir1 + Ph)))
+    {
+    Res = true;
+    ResetBits(_DNFR, (1<<(CLy_adir1 + Ph)));
+    }
+  return Res;
+  }
+
+uint8_t LinkyHistTIC::adir(uint8_t Ph)
+  {
+  return _adir[Ph];
+  }
 #endif  /* LKY_ITri */
 
 
@@ -14,6 +14,13 @@ Lit les trames et decode les groupes :   |<--  Switches d'option   -->|
  IINST1 : intensite instantanee en A.....|      |      |       |   X  |
  IINST2 : intensite instantanee en A.....|      |      |       |   X  |
  IINST3 : intensite instantanee en A.....|      |      |       |   X  |
+ IMAX1  : intensite maximale en A........|      |      |       |   X  |
+ IMAX2  : intensite maximale en A........|      |      |       |   X  |
+ IMAX3  : intensite maximale en A........|      |      |       |   X  |
+ PMAX   : puissance maximale en W........|      |      |       |   X  |
+ ADIR1  : depassement d'intensite en A...|      |      |       |   X  |
+ ADIR2  : depassement d'intensite en A...|      |      |       |   X  |
+ ADIR3  : depassement d'intensite en A...|      |      |       |   X  |
 
 Reference : ERDF-NOI-CPT_54E V3
 
@@ -23,6 +30,10 @@ V10a : initial version, parametric. Compiled OK on 22/10/19.
 V10b : fixed bug in ptecIsNew().
 V10c : added LKYSIMINPUT mode
 V10d : adapted to Arduino Uno and Mega.
+V10e : even parity check, resync on LF/STX/ETX/EOT, error classes.
+       added frameIsNew().
+       ITri : fixed missing break after IINSTx, added IMAXx, PMAX and
+       ADIRx, _DNFR on 16 bits.
 
 ***********************************************************************/
 #ifndef _LinkyHistTIC
@@ -41,6 +52,8 @@ V10d : adapted to Arduino Uno and Mega.
 //#define LINKYDEBUG true     /* Verbose debugging mode */
 //#define LKYSIMINPUT true    /* Simulated Linky input on Serial */
                               /* AVR328 (Uno) processor only */
+//#define LKY_NOPARITY true   /* Do not check the 7E1 parity bit */
+                              /* Forced by LKYSIMINPUT */
 
 /************* tariffs and intensities configuration ******************/
 //#define LKY_Base true        /* Exclusif avec LKY_HPHC */
@@ -61,6 +74,10 @@ V10d : adapted to Arduino Uno and Mega.
 #undef ARDUINOMEGA
 #endif
 
+#if (defined (LKYSIMINPUT) && !defined (LKY_NOPARITY))
+#define LKY_NOPARITY true      /* A terminal sends 8N1, not 7E1 */
+#endif
+
 #if !(defined (LKYSIMINPUT) || defined (ARDUINOMEGA))
 #define LKYSOFTSERIAL true
 #endif
@@ -96,6 +113,9 @@ class LinkyHistTIC
                         /* Initialisation, call from setup() */
     void Update();      /* Update, call from loop() */
 
+    bool frameIsNew();  /* Returns true if a frame end (ETX) has
+                         * been received since last call */
+
     bool pappIsNew();   /* Returns true if papp has changed */
     uint16_t papp();    /* Returns papp in VA */
 
@@ -124,14 +144,35 @@ class LinkyHistTIC
     bool iinstIsNew(uint8_t Ph);  /* Returns true if iinst(Ph)
                                    * has changed */
     uint8_t iinst(uint8_t Ph);    /* Returns iinst(Ph) in A */
+    bool imaxIsNew(uint8_t Ph);   /* Returns true if imax(Ph)
+                                   * has changed */
+    uint8_t imax(uint8_t Ph);     /* Returns imax(Ph) in A */
+    bool pmaxIsNew();   /* Returns true if pmax has changed */
+    uint32_t pmax();    /* Returns pmax in W */
+    bool adirIsNew(uint8_t Ph);   /* Returns true if ADIR(Ph) has
+                                   * been received, even unchanged */
+    uint8_t adir(uint8_t Ph);     /* Returns adir(Ph) in A */
     #endif
 
+    enum Errors:uint8_t {C_Err_Parity, C_Err_Overrun, C_Err_Cks, \
+                         C_Err_Frame, C_Err_Nb};
+    bool errIsNew();    /* Returns true if a line error occurred */
+    uint8_t err();      /* Class of the last error (Errors) */
+    uint16_t errCount(uint8_t Cl);  /* Number of errors of class Cl,
+                                     * 0 if Cl >= C_Err_Nb */
+
   private:
+    void _SetErr(uint8_t Cl);   /* Records an error of class Cl */
+
     char _BfA[CLy_BfSz];        /* Buffer A */
     char _BfB[CLy_BfSz];        /* Buffer B */
 
     uint8_t _FR;                /* Flag register */
+    #ifdef LKY_ITri
+    uint16_t _DNFR;             /* Data new flag register */
+    #else
     uint8_t _DNFR;              /* Data new flag register */
+    #endif
 
     uint16_t _papp;
 
@@ -152,6 +193,9 @@ class LinkyHistTIC
 
     #ifdef LKY_ITri
     uint8_t _iinst[3];  /* Intensite instantanee pour chaque phase */
+    uint8_t _imax[3];   /* Intensite maximale pour chaque phase */
+    uint8_t _adir[3];   /* Depassement d'intensite pour chaque phase */
+    uint32_t _pmax;     /* Puissance maximale triphasee en W */
     #endif
 
     #ifdef LKYSOFTSERIAL
@@ -169,6 +213,9 @@ class LinkyHistTIC
     uint8_t _iCks;   /* Index of Cks in the received message */
     uint8_t _GId;    /* Group identification */
 
+    uint8_t _Err;                  /* Class of the last error */
+    uint16_t _ErrCnt[C_Err_Nb];    /* Error counters, per class */
+
   };
   
 #endif /* _LinkyHistTIC */
@@ -0,0 +1,153 @@
+/***********************************************************************
+               Objet publication sur evenement
+               (report by exception) des valeurs du compteur.
+
+V10e : initial version.
+
+***********************************************************************/
+
+/***************************** Includes *******************************/
+#include "LinkyRbe.h"
+
+/***********************************************************************
+                  Decision de publication, a chaque trame
+
+  Pour un champ du masque, configure et ayant recu une valeur v :
+    - jamais publie                          -> publie,
+    - monotone et v < derniere publiee       -> v ignoree,
+    - moins de minInt s depuis la derniere   -> attend,
+    - |v - pub| >= max(absDb, pub x relDb / 1000) et > 0
+                                             -> publie,
+    - plus de maxSil s depuis la derniere    -> publie (heartbeat).
+
+  flags :
+
+    |  7  |  6  |  5  |  4  |  3   |   2   |   1   |   0   |
+    |     |     |     |     | _Val | _Pub  | _Mono | _Cfg  |
+
+     _Cfg  : field configured
+     _Mono : monotonic field (index)
+     _Pub  : published at least once
+     _Val  : a value has been offered
+
+***********************************************************************/
+
+/****************************** Macros ********************************/
+#ifndef SetBits
+#define SetBits(Data, Mask) \
+Data |= Mask
+#endif
+
+/************************* Defines and const  **************************/
+const uint8_t bRb_Cfg = 0x01;    /* Field configured */
+const uint8_t bRb_Mono = 0x02;   /* Monotonic field */
+const uint8_t bRb_Pub = 0x04;    /* Published at least once */
+const uint8_t bRb_Val = 0x08;    /* Value offered */
+
+/*************** Constructor, methods and properties ******************/
+LinkyRbe::LinkyRbe()
+  {
+  uint8_t i;
+
+  for (i = 0; i < CRb_NbFd; i++)
+    {
+    _Fd[i].flags = 0;
+    _Fd[i].val = 0;
+    _Fd[i].pub = 0;
+    _Fd[i].tPub = 0;
+    }
+  }
+
+void LinkyRbe::Config(uint8_t Fd, uint32_t AbsDb, uint16_t RelDb, \
+                      uint16_t MinInt, uint16_t MaxSil, bool Mono)
+  {
+  if (Fd >= CRb_NbFd)
+    {
+    return;
+    }
+  _Fd[Fd].absDb = AbsDb;
+  _Fd[Fd].relDb = RelDb;
+  _Fd[Fd].minInt = MinInt;
+  _Fd[Fd].maxSil = MaxSil;
+  _Fd[Fd].flags = (_Fd[Fd].flags & bRb_Val) | bRb_Cfg;
+  if (Mono)
+    {
+    SetBits(_Fd[Fd].flags, bRb_Mono);
+    }
+  }
+
+void LinkyRbe::Offer(uint8_t Fd, uint32_t Val)
+  {
+  if (Fd < CRb_NbFd)
+    {
+    _Fd[Fd].val = Val;
+    SetBits(_Fd[Fd].flags, bRb_Val);
+    }
+  }
+
+uint8_t LinkyRbe::Frame(uint32_t t, uint8_t Mask)
+  {
+  Field *pF;
+  uint32_t d, db, dt;
+  uint8_t i, Res = 0;
+  bool Pub;
+
+  for (i = 0; i < CRb_NbFd; i++)
+    {
+    pF = &_Fd[i];
+    if (!(Mask & (1 << i)) || !(pF->flags & bRb_Cfg) || \
+        !(pF->flags & bRb_Val))
+      {  /* Not asked, not configured or never decoded */
+      continue;
+      }
+
+    if (!(pF->flags & bRb_Pub))
+      {  /* First value */
+      Pub = true;
+      }
+      else
+      {
+      if ((pF->flags & bRb_Mono) && (pF->val < pF->pub))
+        {  /* Index going back, keep the published one */
+        pF->val = pF->pub;
+        }
+
+      dt = t - pF->tPub;
+      d = (pF->val > pF->pub) ? pF->val - pF->pub : pF->pub - pF->val;
+      db = (pF->pub / 1000) * pF->relDb + \
+           ((pF->pub % 1000) * pF->relDb) / 1000;
+      if (db < pF->absDb)
+        {
+        db = pF->absDb;
+        }
+
+      Pub = false;
+      if (dt >= (uint32_t) pF->minInt * 1000)
+        {
+        Pub = (d > 0) && (d >= db);
+        }
+      if ((pF->maxSil != 0) && (dt >= (uint32_t) pF->maxSil * 1000))
+        {  /* Heartbeat */
+        Pub = true;
+        }
+      }
+
+    if (Pub)
+      {
+      pF->pub = pF->val;
+      pF->tPub = t;
+      SetBits(pF->flags, bRb_Pub);
+      Res |= (1 << i);
+      }
+    }
+  return Res;
+  }
+
+uint32_t LinkyRbe::value(uint8_t Fd)
+  {
+  return (Fd < CRb_NbFd) ? _Fd[Fd].pub : 0;
+  }
+
+/***********************************************************************
+               Fin d'objet publication sur evenement
+***********************************************************************/
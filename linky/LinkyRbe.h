@@ -0,0 +1,71 @@
+/***********************************************************************
+               Objet publication sur evenement
+               (report by exception) des valeurs du compteur.
+
+Pour chaque champ :
+ - bande morte absolue et relative : seul un ecart significatif
+   depuis la derniere valeur publiee est publie,
+ - intervalle minimal entre deux publications,
+ - silence maximal : la valeur est republiee (heartbeat) au-dela,
+ - option monotone pour les index : une valeur qui recule n'est
+   jamais publiee.
+Une valeur est proposee (Offer()) quand elle est decodee ; un champ
+jamais propose n'est jamais publie. Frame() choisit en une fois les
+champs a publier parmi ceux du masque : une trame donne au plus un
+message.
+
+Arithmetique entiere, pas de dependance Arduino : compile aussi sur
+PC (host).
+
+V10e : initial version.
+
+***********************************************************************/
+#ifndef _LinkyRbe
+#define _LinkyRbe true
+
+/*************************** Includes ********************************/
+#include <stdint.h>
+
+/********************** Defines and consts ***************************/
+#define CRb_NbFd 8             /* Maximum number of fields, fits the
+                                * uint8_t mask returned by Frame() */
+
+/******************************** Class *******************************
+      LinkyRbe : report by exception of the meter values
+***********************************************************************/
+
+class LinkyRbe
+  {
+  public:
+    LinkyRbe();         /* Constructor */
+
+    void Config(uint8_t Fd, uint32_t AbsDb, uint16_t RelDb, \
+                uint16_t MinInt, uint16_t MaxSil, bool Mono = false);
+                        /* Field Fd : deadbands (absolute, relative
+                         * in per mille), minimum interval and maximum
+                         * silence in s (0 = none), monotonic index */
+    void Offer(uint8_t Fd, uint32_t Val);
+                        /* Latest value of field Fd */
+    uint8_t Frame(uint32_t t, uint8_t Mask = 0xff);
+                        /* End of frame at t ms, returns the mask of
+                         * the fields of Mask to publish now (bit Fd) */
+    uint32_t value(uint8_t Fd);     /* Value to publish for field Fd */
+
+  private:
+    struct Field
+      {
+      uint32_t absDb;   /* Absolute deadband */
+      uint32_t val;     /* Latest value offered */
+      uint32_t pub;     /* Last published value */
+      uint32_t tPub;    /* Time of last publication in ms */
+      uint16_t relDb;   /* Relative deadband in per mille */
+      uint16_t minInt;  /* Minimum interval in s */
+      uint16_t maxSil;  /* Maximum silence in s, 0 = none */
+      uint8_t flags;    /* Cf. bRb_xxx */
+      };
+
+    Field _Fd[CRb_NbFd];
+  };
+
+#endif /* _LinkyRbe */
+/*************************** End of code ******************************/
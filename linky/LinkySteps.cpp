@@ -0,0 +1,302 @@
+/***********************************************************************
+               Objet detecteur d'evenements appareils
+               (marche / arret) sur la puissance apparente PAPP.
+
+V10e : initial version.
+
+***********************************************************************/
+
+/***************************** Includes *******************************/
+#include "LinkySteps.h"
+
+/***********************************************************************
+                  Detecteur d'echelons sur PAPP
+
+  Pour chaque echantillon Pa :
+    d  = Pa - niveau
+    k  = max(2 x bruit, MinStep / 2)     derive admise
+    h  = max(4 x bruit, MinStep / 2)     seuil de decision
+    Gp = max(0, Gp + d - k)              echelons montants
+    Gn = max(0, Gn - d - k)              echelons descendants
+
+  Un echelon >= MinStep est detecte des le premier echantillon ; un
+  echelon plus petit mais > k est detecte apres quelques echantillons.
+  Quand Gp ou Gn atteint h : evenement dVA = d, le niveau prend la
+  valeur Pa et les CUSUM repartent de 0.
+  Sinon, si |d| < h, le niveau et le bruit suivent lentement le
+  signal (moyennes exponentielles 1/8 et 1/16, en VA x 16).
+
+  Signatures : un echelon de |dVA| correspond a la signature la plus
+  proche a +/- max(va / 8, CSd_MinTol) pres. Sinon une nouvelle
+  signature non etiquetee est creee, a la place de la moins frequente
+  des non etiquetees si toutes sont prises. Un echelon montant marque
+  l'appareil en marche, le descendant suivant donne la duree.
+
+***********************************************************************/
+
+/************************* Local functions ****************************/
+static inline int32_t Sd_Abs(int32_t x)
+  {
+  return (x < 0) ? -x : x;
+  }
+
+static inline int32_t Sd_Max(int32_t a, int32_t b)
+  {
+  return (a > b) ? a : b;
+  }
+
+/*************** Constructor, methods and properties ******************/
+LinkyStepDet::LinkyStepDet()
+  {
+  Init();
+  }
+
+void LinkyStepDet::Init(uint16_t MinStep)
+  {
+  uint8_t i;
+
+  _MinStep = MinStep;
+  _Lvl = 0;
+  _Nse = 0;
+  _Gp = 0;
+  _Gn = 0;
+  _iEv = 0;
+  _nEv = 0;
+  _EvNew = false;
+  _Run = false;
+
+  for (i = 0; i < CSd_SigSz; i++)
+    {
+    _Sig[i].tOn = 0;
+    _Sig[i].va = 0;
+    _Sig[i].cnt = 0;
+    _Sig[i].label = CSd_NoLabel;
+    _Sig[i].on = false;
+    }
+  }
+
+void LinkyStepDet::Feed(uint16_t Pa, uint32_t t)
+  {
+  int32_t d, k, h;
+
+  if (!_Run)
+    {  /* First sample, sets the level */
+    _Run = true;
+    _Lvl = (int32_t) Pa * 16;
+    return;
+    }
+
+  d = (int32_t) Pa - _Lvl / 16;
+  k = Sd_Max(_Nse / 8, _MinStep / 2);
+  h = Sd_Max(_Nse / 4, _MinStep / 2);
+
+  _Gp = Sd_Max(0, _Gp + d - k);
+  _Gn = Sd_Max(0, _Gn - d - k);
+
+  if ((_Gp >= h) || (_Gn >= h))
+    {  /* Step detected */
+    if (d > 32767)
+      {
+      d = 32767;
+      }
+    if (d < -32767)
+      {
+      d = -32767;
+      }
+    _Step((int16_t) d, t);
+    _Lvl = (int32_t) Pa * 16;
+    _Gp = 0;
+    _Gn = 0;
+    }
+    else
+    {
+    if (Sd_Abs(d) < h)
+      {  /* Inlier, track slow drift and noise */
+      _Lvl += ((int32_t) Pa * 16 - _Lvl) / 8;
+      _Nse += (Sd_Abs(d) * 16 - _Nse) / 16;
+      }
+    }
+  }
+
+uint8_t LinkyStepDet::_Alloc()
+  {
+  uint8_t i, Res = CSd_NoSig;
+
+  for (i = 0; i < CSd_SigSz; i++)
+    {
+    if (_Sig[i].va == 0)
+      {  /* Free slot */
+      return i;
+      }
+    if ((_Sig[i].label == CSd_NoLabel) && \
+        ((Res == CSd_NoSig) || (_Sig[i].cnt < _Sig[Res].cnt)))
+      {  /* Least used unlabelled slot so far */
+      Res = i;
+      }
+    }
+  return Res;
+  }
+
+uint8_t LinkyStepDet::_Match(uint16_t Va)
+  {
+  uint8_t i, Res = CSd_NoSig;
+  int32_t dt, tol, best = 0;
+
+  for (i = 0; i < CSd_SigSz; i++)
+    {
+    if (_Sig[i].va != 0)
+      {
+      dt = Sd_Abs((int32_t) _Sig[i].va - Va);
+      tol = Sd_Max(_Sig[i].va / 8, CSd_MinTol);
+      if ((dt <= tol) && ((Res == CSd_NoSig) || (dt < best)))
+        {
+        Res = i;
+        best = dt;
+        }
+      }
+    }
+
+  if (Res == CSd_NoSig)
+    {  /* Unknown step, new signature */
+    Res = _Alloc();
+    if (Res != CSd_NoSig)
+      {
+      _Sig[Res].va = Va;
+      _Sig[Res].cnt = 0;
+      _Sig[Res].label = CSd_NoLabel;
+      _Sig[Res].on = false;
+      }
+    }
+  return Res;
+  }
+
+void LinkyStepDet::_Step(int16_t dVa, uint32_t t)
+  {
+  Event *pEv;
+  uint16_t Va;
+  uint32_t dur = 0;
+  uint8_t s;
+
+  Va = (uint16_t) Sd_Abs(dVa);
+  s = _Match(Va);
+
+  if (s != CSd_NoSig)
+    {
+    if (_Sig[s].cnt < 255)
+      {
+      _Sig[s].cnt += 1;
+      }
+    _Sig[s].va += ((int32_t) Va - _Sig[s].va) / 4;
+
+    if (dVa > 0)
+      {  /* Appliance on */
+      _Sig[s].on = true;
+      _Sig[s].tOn = t;
+      }
+      else
+      {  /* Appliance off */
+      if (_Sig[s].on)
+        {
+        dur = (t - _Sig[s].tOn) / 1000;
+        if (dur > 65535)
+          {
+          dur = 65535;
+          }
+        }
+      _Sig[s].on = false;
+      }
+    }
+
+  pEv = &_Ev[_iEv];
+  pEv->t = t;
+  pEv->dva = dVa;
+  pEv->dur = (uint16_t) dur;
+  pEv->sig = s;
+
+  _iEv += 1;
+  if (_iEv >= CSd_EvSz)
+    {
+    _iEv = 0;
+    }
+  if (_nEv < CSd_EvSz)
+    {
+    _nEv += 1;
+    }
+  _EvNew = true;
+  }
+
+bool LinkyStepDet::eventIsNew()
+  {
+  bool Res = _EvNew;
+
+  _EvNew = false;
+  return Res;
+  }
+
+uint8_t LinkyStepDet::eventCount()
+  {
+  return _nEv;
+  }
+
+bool LinkyStepDet::event(uint8_t i, Event &Ev)
+  {
+  if (i >= _nEv)
+    {
+    return false;
+    }
+  Ev = _Ev[(_iEv + CSd_EvSz - 1 - i) % CSd_EvSz];
+  return true;
+  }
+
+void LinkyStepDet::Learn(uint16_t Va, uint8_t Lb)
+  {
+  uint8_t s;
+
+  s = _Match(Va);
+  if (s != CSd_NoSig)
+    {
+    _Sig[s].label = Lb;
+    }
+  }
+
+void LinkyStepDet::Label(uint8_t Sg, uint8_t Lb)
+  {
+  if (Sg < CSd_SigSz)
+    {
+    _Sig[Sg].label = Lb;
+    }
+  }
+
+uint8_t LinkyStepDet::sigLabel(uint8_t Sg)
+  {
+  return (Sg < CSd_SigSz) ? _Sig[Sg].label : CSd_NoLabel;
+  }
+
+uint16_t LinkyStepDet::sigVA(uint8_t Sg)
+  {
+  return (Sg < CSd_SigSz) ? _Sig[Sg].va : 0;
+  }
+
+uint8_t LinkyStepDet::sigCount(uint8_t Sg)
+  {
+  return (Sg < CSd_SigSz) ? _Sig[Sg].cnt : 0;
+  }
+
+bool LinkyStepDet::sigIsOn(uint8_t Sg)
+  {
+  return (Sg < CSd_SigSz) ? _Sig[Sg].on : false;
+  }
+
+uint16_t LinkyStepDet::level()
+  {
+  return (uint16_t) (_Lvl / 16);
+  }
+
+uint16_t LinkyStepDet::noise()
+  {
+  return (uint16_t) (_Nse / 16);
+  }
+
+/***********************************************************************
+               Fin d'objet detecteur d'evenements appareils
+***********************************************************************/
@@ -0,0 +1,107 @@
+/***********************************************************************
+               Objet detecteur d'evenements appareils
+               (marche / arret) sur la puissance apparente PAPP.
+
+Recoit un echantillon PAPP par trame (~1 a 2 s) et detecte les
+echelons de puissance :
+ - CUSUM bilateral sur l'ecart au niveau de base,
+ - derive (k) et seuil (h) adaptes au bruit mesure (ecart absolu moyen),
+ - chaque echelon produit un evenement horodate (dVA, duree) range
+   dans un petit anneau,
+ - les echelons recurrents sont regroupes en signatures, qui peuvent
+   etre etiquetees (appareils connus).
+
+Memoire constante, nombre de cycles borne par echantillon (une boucle
+sur CSd_SigSz signatures au plus). Arithmetique entiere uniquement,
+pas de dependance Arduino : compile aussi sur PC (host).
+
+V10e : initial version.
+
+***********************************************************************/
+#ifndef _LinkySteps
+#define _LinkySteps true
+
+/*************************** Includes ********************************/
+#include <stdint.h>
+
+/********************** Defines and consts ***************************/
+#define CSd_EvSz 8             /* Size of the event ring */
+#define CSd_SigSz 6            /* Number of step signatures */
+
+const uint16_t CSd_MinStep = 100;  /* Minimum step detected in VA */
+const uint16_t CSd_MinTol = 30;    /* Minimum signature tolerance in VA */
+const uint8_t CSd_NoLabel = 0;     /* Signature not labelled */
+const uint8_t CSd_NoSig = 0xff;    /* Event without signature */
+
+/******************************** Class *******************************
+      LinkyStepDet : appliance on/off step detector on PAPP
+***********************************************************************/
+
+class LinkyStepDet
+  {
+  public:
+    struct Event
+      {
+      uint32_t t;     /* Time of the step in ms (millis()) */
+      int16_t dva;    /* Step in VA, > 0 : on, < 0 : off */
+      uint16_t dur;   /* Off event : time on in s, else 0 */
+      uint8_t sig;    /* Signature index or CSd_NoSig */
+      };
+
+    LinkyStepDet();     /* Constructor */
+
+    void Init(uint16_t MinStep = CSd_MinStep);
+                        /* Initialisation, call from setup() */
+    void Feed(uint16_t Pa, uint32_t t);
+                        /* New PAPP sample Pa in VA at time t in ms,
+                         * call once per frame */
+
+    bool eventIsNew();  /* Returns true if an event has been added */
+    uint8_t eventCount();            /* Number of events in the ring */
+    bool event(uint8_t i, Event &Ev);
+                        /* Event i (0 = latest), false if none */
+
+    void Learn(uint16_t Va, uint8_t Lb);
+                        /* Preloads a labelled signature of Va VA */
+    void Label(uint8_t Sg, uint8_t Lb);  /* Labels signature Sg */
+    uint8_t sigLabel(uint8_t Sg);   /* Label of signature Sg, the
+                                     * sig* return 0 for CSd_NoSig */
+    uint16_t sigVA(uint8_t Sg);     /* Step of signature Sg in VA */
+    uint8_t sigCount(uint8_t Sg);   /* Occurrences of signature Sg */
+    bool sigIsOn(uint8_t Sg);       /* Signature Sg is running */
+
+    uint16_t level();   /* Current base level in VA */
+    uint16_t noise();   /* Current noise floor in VA */
+
+  private:
+    struct Sig
+      {
+      uint32_t tOn;     /* Time of the last on step in ms */
+      uint16_t va;      /* Step in VA, 0 = free slot */
+      uint8_t cnt;      /* Occurrences (saturated at 255) */
+      uint8_t label;    /* Label or CSd_NoLabel */
+      bool on;          /* Appliance running */
+      };
+
+    uint8_t _Alloc();     /* Free or least used unlabelled slot */
+    uint8_t _Match(uint16_t Va);
+                        /* Signature matching Va, a new one is
+                         * allocated if none matches */
+    void _Step(int16_t dVa, uint32_t t);  /* Records a step */
+
+    Event _Ev[CSd_EvSz];      /* Event ring */
+    Sig _Sig[CSd_SigSz];      /* Signatures */
+
+    int32_t _Lvl;       /* Base level in VA x 16 */
+    int32_t _Nse;       /* Mean absolute deviation in VA x 16 */
+    int32_t _Gp;        /* CUSUM, upward steps in VA */
+    int32_t _Gn;        /* CUSUM, downward steps in VA */
+    uint16_t _MinStep;  /* Minimum step in VA */
+    uint8_t _iEv;       /* Index of the next event in the ring */
+    uint8_t _nEv;       /* Number of events in the ring */
+    bool _EvNew;        /* An event has been added */
+    bool _Run;          /* First sample received */
+  };
+
+#endif /* _LinkySteps */
+/*************************** End of code ******************************/
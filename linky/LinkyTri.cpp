@@ -0,0 +1,196 @@
+/***********************************************************************
+               Objet analyse triphasee : desequilibre, pointes
+               par phase, depassements IMAX / PMAX.
+
+V10e : initial version.
+
+***********************************************************************/
+
+/***************************** Includes *******************************/
+#include "LinkyTri.h"
+
+/***********************************************************************
+                  Analyse triphasee
+
+  Desequilibre : S = I1 + I2 + I3, ecart max a la moyenne
+    imb = max |3 x Ii - S| x 1000 / S          (0 si S = 0)
+
+  Pointe glissante : la fenetre CTr_PkWin est coupee en deux moities,
+  pointe = max(moitie en cours, moitie precedente) : elle couvre entre
+  une demi et une fenetre entiere, en 2 octets par phase.
+
+  Temps au-dessus du seuil : le temps ecoule depuis le Feed()
+  precedent est compte si la phase etait au-dessus du seuil (valeur
+  maintenue entre deux trames), borne a 2 x CTr_FrameMax : une
+  coupure de la ligne TIC n'est pas comptee comme une surcharge.
+  Seuil = SetThr(), rien n'est compte tant qu'il vaut 0.
+
+***********************************************************************/
+
+/*************** Constructor, methods and properties ******************/
+LinkyTri::LinkyTri()
+  {
+  uint8_t i;
+
+  for (i = 0; i < CTr_NbPh; i++)
+    {
+    _Over[i] = 0;
+    _I[i] = 0;
+    _PkCur[i] = 0;
+    _PkPrv[i] = 0;
+    _imax[i] = 0;
+    _Thr[i] = 0;
+    }
+  _tLast = 0;
+  _tWin = 0;
+  _pmax = 0;
+  _Imb = 0;
+  _Run = false;
+  _EvNew = false;
+  _Ev.t = 0;
+  _Ev.ph = 0;
+  _Ev.a = 0;
+  }
+
+void LinkyTri::Feed(uint8_t I1, uint8_t I2, uint8_t I3, uint32_t t)
+  {
+  uint32_t dt;
+  uint16_t S, d, dMax = 0;
+  uint8_t i, Th;
+
+  if (!_Run)
+    {
+    _Run = true;
+    _tLast = t;
+    _tWin = t;
+    }
+
+  if (t - _tWin >= CTr_PkWin / 2)
+    {  /* New half window */
+    _tWin = t;
+    for (i = 0; i < CTr_NbPh; i++)
+      {
+      _PkPrv[i] = _PkCur[i];
+      _PkCur[i] = 0;
+      }
+    }
+
+  dt = t - _tLast;
+  if (dt > 2 * CTr_FrameMax)
+    {  /* Frames lost, the previous values are stale */
+    dt = 2 * CTr_FrameMax;
+    }
+  for (i = 0; i < CTr_NbPh; i++)
+    {  /* Time over threshold with the previous values */
+    Th = thr(i);
+    if ((Th != 0) && (_I[i] > Th))
+      {
+      _Over[i] += dt;
+      }
+    }
+  _tLast = t;
+
+  _I[0] = I1;
+  _I[1] = I2;
+  _I[2] = I3;
+  S = (uint16_t) I1 + I2 + I3;
+
+  for (i = 0; i < CTr_NbPh; i++)
+    {
+    if (_I[i] > _PkCur[i])
+      {
+      _PkCur[i] = _I[i];
+      }
+    d = 3 * _I[i];
+    d = (d > S) ? d - S : S - d;
+    if (d > dMax)
+      {
+      dMax = d;
+      }
+    }
+
+  _Imb = (S == 0) ? 0 : (uint16_t) (((uint32_t) dMax * 1000) / S);
+  }
+
+void LinkyTri::Imax(uint8_t Ph, uint8_t A)
+  {
+  if (Ph < CTr_NbPh)
+    {
+    _imax[Ph] = A;
+    }
+  }
+
+void LinkyTri::Pmax(uint32_t W)
+  {
+  _pmax = W;
+  }
+
+void LinkyTri::Adir(uint8_t Ph, uint8_t A, uint32_t t)
+  {
+  if (Ph < CTr_NbPh)
+    {
+    _Ev.t = t;
+    _Ev.ph = Ph;
+    _Ev.a = A;
+    _EvNew = true;
+    }
+  }
+
+void LinkyTri::SetThr(uint8_t Ph, uint8_t A)
+  {
+  if (Ph < CTr_NbPh)
+    {
+    _Thr[Ph] = A;
+    }
+  }
+
+uint16_t LinkyTri::imbalance()
+  {
+  return _Imb;
+  }
+
+uint8_t LinkyTri::peak(uint8_t Ph)
+  {
+  if (Ph >= CTr_NbPh)
+    {
+    return 0;
+    }
+  return (_PkCur[Ph] > _PkPrv[Ph]) ? _PkCur[Ph] : _PkPrv[Ph];
+  }
+
+uint32_t LinkyTri::over(uint8_t Ph)
+  {
+  return (Ph < CTr_NbPh) ? _Over[Ph] / 1000 : 0;
+  }
+
+uint8_t LinkyTri::thr(uint8_t Ph)
+  {
+  return (Ph < CTr_NbPh) ? _Thr[Ph] : 0;
+  }
+
+uint8_t LinkyTri::imax(uint8_t Ph)
+  {
+  return (Ph < CTr_NbPh) ? _imax[Ph] : 0;
+  }
+
+uint32_t LinkyTri::pmax()
+  {
+  return _pmax;
+  }
+
+bool LinkyTri::eventIsNew()
+  {
+  bool Res = _EvNew;
+
+  _EvNew = false;
+  return Res;
+  }
+
+LinkyTri::Event LinkyTri::event()
+  {
+  return _Ev;
+  }
+
+/***********************************************************************
+               Fin d'objet analyse triphasee
+***********************************************************************/
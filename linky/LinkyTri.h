@@ -0,0 +1,91 @@
+/***********************************************************************
+               Objet analyse triphasee : desequilibre, pointes
+               par phase, depassements IMAX / PMAX.
+
+Alimente par le decodeur (LKY_ITri) :
+ - Feed() a chaque trame avec IINST1..3 : desequilibre entre phases,
+   pointe glissante et temps passe au-dessus du seuil par phase ;
+   pas de seuil par defaut, il est donne par SetThr() (IMAX vaut
+   toujours 90 A sur un Linky, les depassements sont declenches par
+   rapport a ISOUSC),
+ - Imax() / Pmax() avec les maxima decodes (IMAX1..3, PMAX),
+ - Adir() des reception d'un ADIRx : evenement de depassement
+   horodate, pour delester avant la coupure du compteur.
+Chaque mise a jour est en temps constant, memoire constante.
+
+Arithmetique entiere, pas de dependance Arduino : compile aussi sur
+PC (host).
+
+V10e : initial version.
+
+***********************************************************************/
+#ifndef _LinkyTri
+#define _LinkyTri true
+
+/*************************** Includes ********************************/
+#include <stdint.h>
+
+/********************** Defines and consts ***************************/
+#define CTr_NbPh 3             /* Number of phases */
+
+const uint32_t CTr_PkWin = 900000;  /* Rolling peak window in ms */
+const uint32_t CTr_FrameMax = 5000; /* Longest normal frame period in
+                                     * ms, time over threshold counts
+                                     * at most 2 x this per Feed() */
+
+/******************************** Class *******************************
+      LinkyTri : three-phase analytics
+***********************************************************************/
+
+class LinkyTri
+  {
+  public:
+    struct Event
+      {
+      uint32_t t;     /* Time of the overload in ms (millis()) */
+      uint8_t ph;     /* Phase, 0..2 */
+      uint8_t a;      /* ADIR value in A */
+      };
+
+    LinkyTri();         /* Constructor */
+
+    void Feed(uint8_t I1, uint8_t I2, uint8_t I3, uint32_t t);
+                        /* IINST1..3 in A at time t in ms, call once
+                         * per frame */
+    void Imax(uint8_t Ph, uint8_t A);   /* IMAX of phase Ph in A */
+    void Pmax(uint32_t W);              /* PMAX in W */
+    void Adir(uint8_t Ph, uint8_t A, uint32_t t);
+                        /* ADIR of phase Ph received at t in ms */
+    void SetThr(uint8_t Ph, uint8_t A); /* Over threshold of Ph in A,
+                                         * 0 = none (default) */
+
+    uint16_t imbalance();           /* Max deviation from the mean,
+                                     * in per mille of the mean */
+    uint8_t peak(uint8_t Ph);       /* Rolling peak of Ph in A, the
+                                     * getters return 0 for a bad Ph */
+    uint32_t over(uint8_t Ph);      /* Time over threshold of Ph in s */
+    uint8_t thr(uint8_t Ph);        /* Threshold of Ph in A */
+    uint8_t imax(uint8_t Ph);       /* Decoded IMAX of Ph in A */
+    uint32_t pmax();                /* Decoded PMAX in W */
+
+    bool eventIsNew();  /* Returns true if an overload was received */
+    Event event();      /* Last overload */
+
+  private:
+    uint32_t _Over[CTr_NbPh];   /* Time over threshold in ms */
+    uint32_t _tLast;            /* Time of the last Feed() in ms */
+    uint32_t _tWin;             /* Start of the current peak bucket */
+    uint32_t _pmax;
+    Event _Ev;                  /* Last overload */
+    uint8_t _I[CTr_NbPh];       /* Last IINST */
+    uint8_t _PkCur[CTr_NbPh];   /* Peak of the current half window */
+    uint8_t _PkPrv[CTr_NbPh];   /* Peak of the previous half window */
+    uint8_t _imax[CTr_NbPh];
+    uint8_t _Thr[CTr_NbPh];     /* User threshold, 0 = none */
+    uint16_t _Imb;              /* Imbalance in per mille */
+    bool _Run;                  /* First sample received */
+    bool _EvNew;                /* New overload */
+  };
+
+#endif /* _LinkyTri */
+/*************************** End of code ******************************/
@@ -2,6 +2,10 @@
 #include <string.h>
 #include <Streaming.h>
 #include "LinkyHistTIC.h"
+#include "LinkySteps.h"
+#include "LinkyCost.h"
+#include "LinkyRbe.h"
+#include "LinkyTri.h"
 
 /************* DEFINES *************/
 #define GREEN_LED 13
@@ -15,6 +19,10 @@
 #define DISTANCE_LIMIT 15.0 
 #define LINKY_RX 10
 #define LINKY_TX 11
+#define ECHO_TIMEOUT 30000UL                                            // pulseIn() timeout in us (~5m)
+#define CMD_LINE_SIZE 32                                                // console line buffer size
+#define DAYS_PER_MONTH 30                                               // no RTC, months are counted in days of uptime
+#define PUBLISH_TIMEOUT 2000                                            // publish period in ms when no TIC frame comes
 
 /************* VARIABLES *************/
 bool isAlertDistanceOn = false;
@@ -26,6 +34,9 @@ unsigned long previousMillisAlertDistance = 0;
 long dureeDistance;
 float distance;
 
+long consumptionLimit = CONSUMPTION_LIMIT;
+float distanceLimit = DISTANCE_LIMIT;
+
 unsigned long previousMillisNumber = 0;
 unsigned long intervalNumber = 500;
 
@@ -35,6 +46,12 @@ float totalPappHourly = 0.0;
 unsigned int pappCounterHourly = 0;
 unsigned long currentMillisHourly = 0;
 
+unsigned long previousMillisDay = 0;
+const unsigned long intervalDay = 86400000UL;
+uint8_t dayOfMonth = 0;
+
+unsigned long previousMillisPublish = 0;
+
 long newNumber = 0;
 long number = 0;
 
@@ -49,6 +66,120 @@ boolean ledStateAlertDistance = false;
 boolean buzzerStateAlert = false;
 
 LinkyHistTIC Linky(LINKY_RX, LINKY_TX);
+LinkyStepDet Steps;
+LinkyCost Cost;
+LinkyRbe Rbe;
+#ifdef LKY_ITri
+LinkyTri Tri;
+#endif
+
+/************* PUBLISHING *************/
+enum PublishField {                                                     // report by exception fields
+  PUB_PAPP,
+  PUB_INDEX1,                                                           // BASE or HCHP
+  PUB_INDEX2,                                                           // HCHC
+  PUB_PTEC,
+  PUB_AL_CONSO,
+  PUB_AL_DIST,
+  PUB_FIELDS
+};
+
+const char keyPapp[] PROGMEM = "papp";
+#ifdef LKY_Base
+const char keyIndex1[] PROGMEM = "base";
+#else
+const char keyIndex1[] PROGMEM = "hchp";
+#endif
+const char keyIndex2[] PROGMEM = "hchc";
+const char keyPtec[] PROGMEM = "ptec";
+const char keyAlConso[] PROGMEM = "al_conso";
+const char keyAlDist[] PROGMEM = "al_dist";
+const char *const publishKeys[PUB_FIELDS] PROGMEM = {
+  keyPapp, keyIndex1, keyIndex2, keyPtec, keyAlConso, keyAlDist
+};
+
+/************* CONSOLE *************/
+char cmdLine[CMD_LINE_SIZE];                                            // line being received
+uint8_t cmdLength = 0;
+bool cmdOverflow = false;                                               // line longer than the buffer
+bool jsonOutput = false;                                                // key=value (false) or JSON (true)
+bool pappDecoded = false;                                               // PAPP received at least once
+bool outFirst = true;
+
+typedef void (*CmdHandler)(char *arg);
+struct Command {
+  char name[6];                                                         // command name
+  CmdHandler handler;                                                   // called with the rest of the line
+  const char *help;                                                     // help string, in PROGMEM
+};
+
+void outBegin();
+void outKey(const __FlashStringHelper *key, long value);
+void outKey(const __FlashStringHelper *key, unsigned long value);
+void outKey(const __FlashStringHelper *key, int value);
+void outKey(const __FlashStringHelper *key, unsigned int value);
+void outKey(const __FlashStringHelper *key, const __FlashStringHelper *value);
+void outEnd();
+void cmdHelp(char *arg);
+void cmdSnapshot(char *arg);
+void cmdCounters(char *arg);
+void cmdAverages(char *arg);
+void cmdEvents(char *arg);
+void cmdThresholds(char *arg);
+void cmdSignatures(char *arg);
+void cmdLabel(char *arg);
+void cmdLearn(char *arg);
+void cmdSet(char *arg);
+void cmdFormat(char *arg);
+void cmdCost(char *arg);
+#ifdef LKY_ITri
+void cmdThreePhase(char *arg);
+#endif
+void cmdAlertConso(char *arg);
+void cmdAlertDistance(char *arg);
+
+const char helpHelp[] PROGMEM = "cette aide";
+const char helpSnap[] PROGMEM = "valeurs actuelles du compteur";
+const char helpCnt[] PROGMEM = "compteurs d'erreurs de la ligne TIC";
+const char helpAvg[] PROGMEM = "moyennes de consommation";
+const char helpEvt[] PROGMEM = "[n] : n derniers evenements appareils";
+const char helpThr[] PROGMEM = "seuils d'alerte";
+const char helpSig[] PROGMEM = "signatures d'appareils";
+const char helpLbl[] PROGMEM = "<sig> <n> : etiquette n pour la signature sig";
+const char helpLearn[] PROGMEM = "<VA> <n> : signature de VA etiquetee n";
+#ifdef LKY_ITri
+const char helpSet[] PROGMEM = "conso|dist|hp|hc|abo|thr1|thr2|thr3 <valeur> : change un seuil ou un tarif (mc, A)";
+#else
+const char helpSet[] PROGMEM = "conso|dist|hp|hc|abo <valeur> : change un seuil ou un tarif (mc)";
+#endif
+const char helpCost[] PROGMEM = "cout du jour, du mois et horaire (mc), Wh non factures";
+#ifdef LKY_ITri
+const char helpTri[] PROGMEM = "desequilibre, pointes, temps > seuil, IMAX, PMAX";
+#endif
+const char helpFmt[] PROGMEM = "kv|json : format de sortie";
+const char helpA[] PROGMEM = "active/desactive l'alerte de consommation";
+const char helpI[] PROGMEM = "active/desactive l'alerte d'intrusion";
+
+const Command commands[] PROGMEM = {
+  {"help", cmdHelp, helpHelp},
+  {"snap", cmdSnapshot, helpSnap},
+  {"cnt", cmdCounters, helpCnt},
+  {"M", cmdAverages, helpAvg},
+  {"evt", cmdEvents, helpEvt},
+  {"thr", cmdThresholds, helpThr},
+  {"sig", cmdSignatures, helpSig},
+  {"lbl", cmdLabel, helpLbl},
+  {"learn", cmdLearn, helpLearn},
+  {"cost", cmdCost, helpCost},
+#ifdef LKY_ITri
+  {"tri", cmdThreePhase, helpTri},
+#endif
+  {"set", cmdSet, helpSet},
+  {"fmt", cmdFormat, helpFmt},
+  {"A", cmdAlertConso, helpA},
+  {"I", cmdAlertDistance, helpI}
+};
+const uint8_t commandCount = sizeof(commands) / sizeof(commands[0]);
 
 /************* FUNCTIONS *************/
 long getNumber() {                                                      // GET PAPP VALUE FROM LINKY
@@ -61,6 +192,117 @@ long getNumber() {                                                      // GET P
   }
 }
 
+void appliances(bool frame) {                                           // APPLIANCE ON/OFF EVENTS
+  LinkyStepDet::Event ev;
+  if (frame && pappDecoded) {                                           // one PAPP sample per frame, once decoded
+    Steps.Feed(Linky.papp(), millis());
+  }
+  if (Steps.eventIsNew() && Steps.event(0, ev)) {                       // a step has been detected
+    outBegin();
+    outKey(F("ev"), F("step"));                                             // unsolicited record, typed
+    outKey(F("dva"), ev.dva);
+    outKey(F("dur"), ev.dur);
+    outKey(F("sig"), ev.sig);
+    outKey(F("label"), Steps.sigLabel(ev.sig));
+    outEnd();
+  }
+}
+
+#ifdef LKY_ITri
+void threePhase(bool frame) {                                           // THREE-PHASE ANALYTICS
+  unsigned long currentMillis = millis();
+  LinkyTri::Event ev;
+  for (uint8_t ph = 0; ph < CTr_NbPh; ph++) {
+    if (Linky.adirIsNew(ph)) {                                          // overload, report at once
+      Tri.Adir(ph, Linky.adir(ph), currentMillis);
+    }
+    if (Tri.eventIsNew()) {
+      ev = Tri.event();
+      outBegin();
+      outKey(F("ev"), F("adir"));                                           // unsolicited record, typed
+      outKey(F("adir"), ev.ph + 1);
+      outKey(F("a"), ev.a);
+      outEnd();
+    }
+    if (Linky.imaxIsNew(ph)) {
+      Tri.Imax(ph, Linky.imax(ph));
+    }
+  }
+  if (Linky.pmaxIsNew()) {
+    Tri.Pmax(Linky.pmax());
+  }
+  if (frame) {                                                          // one sample of the 3 phases per frame
+    Tri.Feed(Linky.iinst(LinkyHistTIC::C_Phase_1), Linky.iinst(LinkyHistTIC::C_Phase_2),
+             Linky.iinst(LinkyHistTIC::C_Phase_3), currentMillis);
+  }
+}
+#endif
+
+void publish(bool frame) {                                              // REPORT BY EXCEPTION
+  unsigned long currentMillis = millis();
+  if (!frame && currentMillis - previousMillisPublish < PUBLISH_TIMEOUT) {
+    return;                                                             // once per frame, or per timeout without meter
+  }
+  previousMillisPublish = currentMillis;
+
+  Rbe.Offer(PUB_AL_CONSO, alertConsoState && isAlertConsoOn);          // meter fields are offered when decoded
+  Rbe.Offer(PUB_AL_DIST, alertDistanceState && isAlertDistanceOn);
+
+  uint8_t fields = (1 << PUB_AL_CONSO) | (1 << PUB_AL_DIST);            // without a frame, sensor alerts only
+  if (frame) {
+    fields = 0xff;
+  }
+  uint8_t mask = Rbe.Frame(currentMillis, fields);                      // only the significant changes
+  if (mask == 0) {
+    return;
+  }
+  outBegin();                                                           // batched in a single record
+  outKey(F("ev"), F("pub"));                                                // unsolicited record, typed
+  for (uint8_t i = 0; i < PUB_FIELDS; i++) {
+    if (mask & (1 << i)) {
+      outKey((const __FlashStringHelper *)pgm_read_ptr(&publishKeys[i]), Rbe.value(i));
+    }
+  }
+  outEnd();
+}
+
+void meterValues() {                                                    // DISPATCH NEWLY DECODED VALUES
+  if (Linky.pappIsNew()) {
+    pappDecoded = true;
+    Rbe.Offer(PUB_PAPP, Linky.papp());
+  }
+#ifdef LKY_Base
+  if (Linky.baseIsNew()) {                                              // charge each index step
+    Cost.Index(0, Linky.base());
+    Rbe.Offer(PUB_INDEX1, Linky.base());
+  }
+#endif
+#ifdef LKY_HPHC
+  if (Linky.hchpIsNew()) {
+    Cost.Index(LinkyHistTIC::C_HPleines, Linky.hchp());
+    Rbe.Offer(PUB_INDEX1, Linky.hchp());
+  }
+  if (Linky.hchcIsNew()) {
+    Cost.Index(LinkyHistTIC::C_HCreuses, Linky.hchc());
+    Rbe.Offer(PUB_INDEX2, Linky.hchc());
+  }
+  if (Linky.ptecIsNew()) {
+    Rbe.Offer(PUB_PTEC, Linky.ptec());
+  }
+#endif
+}
+
+void costs() {                                                          // DAILY COST ROLLOVER
+  if (millis() - previousMillisDay >= intervalDay) {                    // new day of uptime
+    previousMillisDay += intervalDay;
+    dayOfMonth += 1;
+    if (dayOfMonth >= DAYS_PER_MONTH) {
+      dayOfMonth = 0;
+    }
+    Cost.NewDay(dayOfMonth == 0);
+  }
+}
+
 void blink() {                                                          // POWER LED BLINKING
   unsigned long currentMillis = millis();                               // get actual time
   if (currentMillis - previousBlinkMillis >= blinkInterval) {           // check if delay is exceeded
@@ -77,7 +319,6 @@ void alertConso() {                                                     // CONSU
     ledStateAlertConso = !ledStateAlertConso;                           // invert led state
     buzzerStateAlert = !buzzerStateAlert;                               // invert buzzer state
     digitalWrite(RED_LED, ledStateAlertConso);                          // write the new state
-    Serial.println("Alerte ! Consommation anormale " + String(number) + "W !");
     if(buzzerStateAlert) {
       tone(BUZZER_PIN,800);                                             // turn the buzzer on
     } else {
@@ -92,8 +333,371 @@ void alertDistance() {                                                  // DISTA
     previousMillisAlertDistance = currentMillis;                        // store current time as the last change
     ledStateAlertDistance = !ledStateAlertDistance;                     // invert led state
     digitalWrite(YELLOW_LED, ledStateAlertDistance);                    // write the new state
-    Serial.println();
-    Serial.println("Alerte intrusion !");                               // write the alert in the serial
+  }
+}
+
+void outBegin() {                                                       // START A RECORD
+  outFirst = true;
+  if (jsonOutput) {
+    Serial.print('{');
+  }
+}
+
+void outName(const __FlashStringHelper *key) {                          // ADD key= TO THE RECORD
+  if (!outFirst) {
+    Serial.print(jsonOutput ? ',' : ' ');
+  }
+  outFirst = false;
+  if (jsonOutput) {
+    Serial.print('"');
+    Serial.print(key);
+    Serial.print(F("\":"));
+  } else {
+    Serial.print(key);
+    Serial.print('=');
+  }
+}
+
+void outKey(const __FlashStringHelper *key, long value) {               // ADD key=value TO THE RECORD
+  outName(key);
+  Serial.print(value);
+}
+
+void outKey(const __FlashStringHelper *key, unsigned long value) {      // uint32 : millis, indexes, costs
+  outName(key);
+  Serial.print(value);
+}
+
+void outKey(const __FlashStringHelper *key, int value) {                // small types, no ambiguity
+  outKey(key, long(value));
+}
+
+void outKey(const __FlashStringHelper *key, unsigned int value) {
+  outKey(key, (unsigned long)value);
+}
+
+void outKey(const __FlashStringHelper *key, const __FlashStringHelper *value) { // text, quoted in JSON
+  outName(key);
+  if (jsonOutput) {
+    Serial.print('"');
+    Serial.print(value);
+    Serial.print('"');
+  } else {
+    Serial.print(value);
+  }
+}
+
+void outEnd() {                                                         // END THE RECORD
+  if (jsonOutput) {
+    Serial.print('}');
+  }
+  Serial.println();
+}
+
+void outError(const __FlashStringHelper *reason) {                      // REPORT A COMMAND ERROR
+  if (jsonOutput) {
+    Serial.print(F("{\"err\":\""));
+    Serial.print(reason);
+    Serial.println(F("\"}"));
+  } else {
+    Serial.print(F("err="));
+    Serial.println(reason);
+  }
+}
+
+void cmdHelp(char *) {                                                  // LIST THE COMMANDS
+  Command cmd;
+  for (uint8_t i = 0; i < commandCount; i++) {
+    memcpy_P(&cmd, &commands[i], sizeof(cmd));
+    Serial.print(cmd.name);
+    Serial.print(F(" : "));
+    Serial.println((const __FlashStringHelper *)cmd.help);
+  }
+}
+
+void cmdSnapshot(char *) {                                              // CURRENT METER VALUES
+  outBegin();
+  outKey(F("papp"), Linky.papp());
+#ifdef LKY_Base
+  outKey(F("base"), Linky.base());
+#endif
+#ifdef LKY_HPHC
+  outKey(F("hchc"), Linky.hchc());
+  outKey(F("hchp"), Linky.hchp());
+  outKey(F("ptec"), Linky.ptec());
+#endif
+#ifdef LKY_IMono
+  outKey(F("iinst"), Linky.iinst());
+#endif
+#ifdef LKY_ITri
+  outKey(F("iinst1"), Linky.iinst(LinkyHistTIC::C_Phase_1));
+  outKey(F("iinst2"), Linky.iinst(LinkyHistTIC::C_Phase_2));
+  outKey(F("iinst3"), Linky.iinst(LinkyHistTIC::C_Phase_3));
+#endif
+  outKey(F("level"), Steps.level());
+  outKey(F("dist"), long(distance));
+  outKey(F("al_conso"), alertConsoState);
+  outKey(F("al_dist"), alertDistanceState);
+  outEnd();
+}
+
+void cmdCounters(char *) {                                              // TIC LINE ERROR COUNTERS
+  outBegin();
+  outKey(F("parity"), Linky.errCount(LinkyHistTIC::C_Err_Parity));
+  outKey(F("overrun"), Linky.errCount(LinkyHistTIC::C_Err_Overrun));
+  outKey(F("cks"), Linky.errCount(LinkyHistTIC::C_Err_Cks));
+  outKey(F("frame"), Linky.errCount(LinkyHistTIC::C_Err_Frame));
+  outKey(F("rec"), pappCounterHourly);
+  outEnd();
+}
+
+void cmdAverages(char *) {                                              // CONSUMPTION AVERAGES
+  long average = 0;
+  if (pappCounterHourly > 0) {
+    average = long(totalPappHourly / pappCounterHourly);               // mean VA, ie Wh per hour
+  }
+  outBegin();
+  outKey(F("rec"), pappCounterHourly);
+  outKey(F("papp"), number);
+  outKey(F("wh_h"), average);
+  outKey(F("wh_d"), average * 24);
+  outKey(F("wh_m"), average * 24 * 31);
+  outEnd();
+}
+
+void cmdEvents(char *arg) {                                             // LATEST APPLIANCE EVENTS
+  LinkyStepDet::Event ev;
+  uint8_t count = CSd_EvSz;
+  if (arg != NULL && *arg != '\0') {
+    count = atoi(arg);
+  }
+  for (uint8_t i = 0; i < count && Steps.event(i, ev); i++) {
+    outBegin();
+    outKey(F("t"), ev.t);
+    outKey(F("dva"), ev.dva);
+    outKey(F("dur"), ev.dur);
+    outKey(F("sig"), ev.sig);
+    if (ev.sig != CSd_NoSig) {
+      outKey(F("label"), Steps.sigLabel(ev.sig));
+    }
+    outEnd();
+  }
+}
+
+void cmdSignatures(char *) {                                            // APPLIANCE SIGNATURES
+  for (uint8_t i = 0; i < CSd_SigSz; i++) {
+    if (Steps.sigVA(i) == 0) {                                          // free slot
+      continue;
+    }
+    outBegin();
+    outKey(F("sig"), i);
+    outKey(F("va"), Steps.sigVA(i));
+    outKey(F("cnt"), Steps.sigCount(i));
+    outKey(F("label"), Steps.sigLabel(i));
+    outKey(F("on"), Steps.sigIsOn(i));
+    outEnd();
+  }
+}
+
+void cmdThresholds(char *) {                                            // ALERT THRESHOLDS
+  outBegin();
+  outKey(F("conso"), consumptionLimit);
+  outKey(F("dist"), long(distanceLimit));
+  outKey(F("al_conso_on"), isAlertConsoOn);
+  outKey(F("al_dist_on"), isAlertDistanceOn);
+  outEnd();
+}
+
+void cmdCost(char *) {                                                  // COST OF THE CONSUMPTION
+  uint8_t period = 0;
+#ifdef LKY_HPHC
+  if (Linky.ptec() == LinkyHistTIC::C_HCreuses) {
+    period = LinkyHistTIC::C_HCreuses;
+  }
+#endif
+  outBegin();
+  outKey(F("day"), Cost.day());
+  outKey(F("month"), Cost.month());
+  outKey(F("rate"), Cost.rate(Linky.papp(), period));
+  outKey(F("hp"), Cost.price(0));
+  outKey(F("hc"), Cost.price(1));
+  outKey(F("abo"), Cost.sub());
+  outKey(F("skip"), Cost.skipped());                                        // Wh not charged, too large steps
+  outEnd();
+}
+
+#ifdef LKY_ITri
+void cmdThreePhase(char *) {                                            // THREE-PHASE ANALYTICS
+  outBegin();
+  outKey(F("imb"), Tri.imbalance());
+  outKey(F("pk1"), Tri.peak(0));
+  outKey(F("pk2"), Tri.peak(1));
+  outKey(F("pk3"), Tri.peak(2));
+  outKey(F("over1"), Tri.over(0));
+  outKey(F("over2"), Tri.over(1));
+  outKey(F("over3"), Tri.over(2));
+  outKey(F("thr1"), Tri.thr(0));
+  outKey(F("thr2"), Tri.thr(1));
+  outKey(F("thr3"), Tri.thr(2));
+  outKey(F("imax1"), Tri.imax(0));
+  outKey(F("imax2"), Tri.imax(1));
+  outKey(F("imax3"), Tri.imax(2));
+  outKey(F("pmax"), Tri.pmax());
+  outEnd();
+}
+#endif
+
+bool parseUnsigned(const char *text, unsigned long &value) {           // DIGITS ONLY, NO SIGN, 9 MAX
+  uint8_t length = 0;
+  value = 0;
+  for (; *text != '\0'; text++) {
+    if (*text < '0' || *text > '9' || length >= 9) {
+      return false;
+    }
+    value = value * 10 + (*text - '0');
+    length += 1;
+  }
+  return length > 0;
+}
+
+bool parseTwo(char *arg, unsigned long &first, unsigned long &second) { // TWO UNSIGNED ARGUMENTS
+  char *text1 = strtok(arg, " ");
+  char *text2 = strtok(NULL, " ");
+  return text1 != NULL && text2 != NULL && parseUnsigned(text1, first) && parseUnsigned(text2, second);
+}
+
+void cmdLabel(char *arg) {                                              // LABEL A SIGNATURE
+  unsigned long sig, label;
+  if (!parseTwo(arg, sig, label) || sig >= CSd_SigSz || Steps.sigVA(sig) == 0 || label > 255) {
+    outError(F("arg"));
+    return;
+  }
+  Steps.Label(sig, label);
+  cmdSignatures(NULL);
+}
+
+void cmdLearn(char *arg) {                                              // PRELOAD A LABELLED SIGNATURE
+  unsigned long va, label;
+  if (!parseTwo(arg, va, label) || va == 0 || va > 65535 || label > 255) {
+    outError(F("arg"));
+    return;
+  }
+  Steps.Learn(va, label);
+  cmdSignatures(NULL);
+}
+
+void cmdSet(char *arg) {                                                // CHANGE A THRESHOLD OR A TARIFF
+  char *key = strtok(arg, " ");
+  char *value = strtok(NULL, " ");
+  unsigned long mc = 0;
+  bool valid = true;
+  bool tariffChanged = false;
+#ifdef LKY_ITri
+  bool phaseChanged = false;
+#endif
+  if (key == NULL || value == NULL) {
+    outError(F("arg"));
+    return;
+  }
+  if (strcmp_P(key, PSTR("conso")) == 0) {
+    consumptionLimit = atol(value);
+  } else if (strcmp_P(key, PSTR("dist")) == 0) {
+    distanceLimit = atof(value);
+  } else if (strcmp_P(key, PSTR("hp")) == 0) {                          // tariffs : unsigned mc, in range
+    valid = parseUnsigned(value, mc) && Cost.SetPrice(0, mc);
+    tariffChanged = true;
+  } else if (strcmp_P(key, PSTR("hc")) == 0) {
+    valid = parseUnsigned(value, mc) && Cost.SetPrice(1, mc);
+    tariffChanged = true;
+  } else if (strcmp_P(key, PSTR("abo")) == 0) {
+    valid = parseUnsigned(value, mc) && Cost.SetSub(mc);
+    tariffChanged = true;
+#ifdef LKY_ITri
+  } else if (strncmp_P(key, PSTR("thr"), 3) == 0 && key[3] >= '1' && key[3] <= '3' && key[4] == '\0') {
+    unsigned long amps = 0;                                                 // phase over threshold, 0 = none
+    valid = parseUnsigned(value, amps) && amps <= 255;
+    if (valid) {
+      Tri.SetThr(key[3] - '1', amps);
+    }
+    phaseChanged = true;
+#endif
+  } else {
+    outError(F("key"));
+    return;
+  }
+  if (!valid) {                                                         // rejected, nothing saved
+    outError(F("arg"));
+  } else if (tariffChanged) {                                           // tariff changed, keep it
+    Cost.Save();
+    cmdCost(NULL);
+#ifdef LKY_ITri
+  } else if (phaseChanged) {
+    cmdThreePhase(NULL);
+#endif
+  } else {
+    cmdThresholds(NULL);
+  }
+}
+
+void cmdFormat(char *arg) {                                             // SELECT THE OUTPUT FORMAT
+  if (arg != NULL && strcmp_P(arg, PSTR("json")) == 0) {
+    jsonOutput = true;
+  } else if (arg != NULL && strcmp_P(arg, PSTR("kv")) == 0) {
+    jsonOutput = false;
+  } else {
+    outError(F("arg"));
+    return;
+  }
+  outBegin();
+  outKey(F("json"), jsonOutput);
+  outEnd();
+}
+
+void cmdAlertConso(char *) {                                            // TOGGLE THE CONSUMPTION ALERT
+  isAlertConsoOn = !isAlertConsoOn;
+  cmdThresholds(NULL);
+}
+
+void cmdAlertDistance(char *) {                                         // TOGGLE THE INTRUSION ALERT
+  isAlertDistanceOn = !isAlertDistanceOn;
+  cmdThresholds(NULL);
+}
+
+void execute(char *line) {                                              // RUN A COMMAND LINE
+  Command cmd;
+  char *name = strtok(line, " ");
+  char *arg = strtok(NULL, "");                                         // rest of the line
+  if (name == NULL) {
+    return;
+  }
+  for (uint8_t i = 0; i < commandCount; i++) {
+    memcpy_P(&cmd, &commands[i], sizeof(cmd));
+    if (strcmp(name, cmd.name) == 0) {
+      cmd.handler(arg);
+      return;
+    }
+  }
+  outError(F("cmd"));
+}
+
+void console() {                                                        // NON-BLOCKING LINE READER
+  while (Serial.available() > 0) {                                      // only what is already received
+    char c = Serial.read();
+    if (c == '\r' || c == '\n') {                                       // end of line
+      if (cmdOverflow) {                                                // too long, never run a cut line
+        outError(F("len"));
+      } else if (cmdLength > 0) {
+        cmdLine[cmdLength] = '\0';
+        execute(cmdLine);
+      }
+      cmdLength = 0;
+      cmdOverflow = false;
+    } else if (cmdLength < CMD_LINE_SIZE - 1) {                         // store
+      cmdLine[cmdLength] = c;
+      cmdLength += 1;
+    } else {
+      cmdOverflow = true;
+    }
   }
 }
 
@@ -108,20 +712,41 @@ void setup() {
   pinMode(ECHO_PIN, INPUT);
   pinMode(MOTOR_PIN, OUTPUT);
   digitalWrite(MOTOR_PIN, HIGH);                                        // turn the motor on
-  Serial.println("Entrez 'M' pour voir les moyennes de consommation, 'A' pour activer/desactiver l'alerte de consommation et 'I' pour activer/desactiver l'alerte d'intrusion");
+  Linky.Init();                                                         // start the TIC decoder
+  Steps.Init();                                                         // start the appliance detector
+  Cost.Init();                                                          // load the tariff
+  Rbe.Config(PUB_PAPP, 50, 50, 5, 300);                                 // 50VA and 5%, 5s min, 5min heartbeat
+#ifdef LKY_Base
+  Rbe.Config(PUB_INDEX1, 100, 0, 60, 900, true);                       // 100Wh, 1min min, 15min heartbeat, monotonic
+#endif
+#ifdef LKY_HPHC
+  Rbe.Config(PUB_INDEX1, 100, 0, 60, 900, true);
+  Rbe.Config(PUB_INDEX2, 100, 0, 60, 900, true);
+  Rbe.Config(PUB_PTEC, 1, 0, 0, 900);                                   // any change, at once
+#endif
+  Rbe.Config(PUB_AL_CONSO, 1, 0, 0, 60);                                // alerts : on change, 1min heartbeat
+  Rbe.Config(PUB_AL_DIST, 1, 0, 0, 60);
 }
 
 /************* LOOP *************/
 void loop() {
+  Linky.Update();                                                       // decode the TIC
+  meterValues();                                                        // charge and offer decoded values
+  bool frame = Linky.frameIsNew();                                      // a complete frame has been received
+  appliances(frame);                                                    // detect appliance on/off
+#ifdef LKY_ITri
+  threePhase(frame);                                                    // imbalance, peaks, overloads
+#endif
+  costs();                                                              // start a new day of costs
   digitalWrite(TRIG_PIN, LOW);                                          // measure the distance
   delayMicroseconds(5);
   digitalWrite(TRIG_PIN, HIGH);
   delayMicroseconds(10);
   digitalWrite(TRIG_PIN, LOW);
-  dureeDistance = pulseIn(ECHO_PIN, HIGH);
+  dureeDistance = pulseIn(ECHO_PIN, HIGH, ECHO_TIMEOUT);                // bounded wait, 0 if no echo
   distance = dureeDistance * 0.017;
   
-  if(distance < DISTANCE_LIMIT) {                                       // turn the alert on or off
+  if(dureeDistance != 0 && distance < distanceLimit) {                      // turn the alert on or off
     alertDistanceState = true;
   } else {
   	alertDistanceState = false;
@@ -142,7 +767,7 @@ void loop() {
   	}
   }
   
-  if(number > CONSUMPTION_LIMIT) {                                     // if we reach the consumption threshold
+  if(number > consumptionLimit) {                                     // if we reach the consumption threshold
     alertConsoState = true;                                            // change alert state
   } else {
   	alertConsoState = false;
@@ -158,34 +783,6 @@ void loop() {
   	digitalWrite(MOTOR_PIN, HIGH);
   }
 
-  if(Serial.available() > 0) {
-    char input = Serial.read();
-    if(input == 'M') {
-      float moyenneHourly = totalPappHourly / (float)pappCounterHourly / 1000;
-      Serial.println();
-      Serial.println("Nombre d'enregistrements : " + String(pappCounterHourly));
-      Serial.println();
-      Serial.println("Consommation actuelle : " + String(number) + "W");
-      Serial.println("Moyenne horraire : " + String(moyenneHourly) + "kWh/heure");
-      Serial.println("Moyenne journaliere : " + String(moyenneHourly*24) + "kWh/jour");
-      Serial.println("Moyenne mensuelle : " + String(moyenneHourly*24*31) + "kWh/mois");
-    }
-    if(input == 'A') {
-      isAlertConsoOn = !isAlertConsoOn;
-      if(isAlertConsoOn) {
-        Serial.println("L'alerte de consommation est activee");
-      } else {
-        Serial.println("L'alerte de consommation est desactivee");
-      }
-    }
-    if(input == 'I') {
-      isAlertDistanceOn = !isAlertDistanceOn;
-      if(isAlertDistanceOn) {
-        Serial.println("L'alerte d'intrustion est activee");
-      } else {
-        Serial.println("L'alerte d'intrustion est desactivee");
-      }
-    }
-    Serial.println("Entrez 'M' pour voir les moyennes de consommation, 'A' pour activer/desactiver l'alerte de consommation et 'I' pour activer/desactiver l'alerte d'intrusion");
-  }
+  publish(frame);                                                       // report significant changes only
+  console();                                                            // handle console commands
 }
\ No newline at end of file